@@ -594,6 +594,11 @@ public:
   void *allocate(unsigned Size, unsigned Align) const;
 
   /// Allocate memory for an instruction using the module's internal allocator.
+  ///
+  /// Unlike allocate(), this does not use the bump allocator: instructions
+  /// are created and destroyed throughout the optimizer pipeline, so they
+  /// come from the system allocator, whose size-class bins recycle the
+  /// blocks that deallocateInst returns.
   void *allocateInst(unsigned Size, unsigned Align) const;
 
   /// Deallocate memory of an instruction.
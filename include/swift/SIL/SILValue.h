@@ -22,12 +22,12 @@
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/ADT/PointerUnion.h"
 #include "llvm/ADT/Hashing.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/raw_ostream.h"
 
 namespace swift {
   class Operand;
   class ValueBaseUseIterator;
-  class ValueUseIterator;
   class SILBasicBlock;
   class SILFunction;
   class SILModule;
@@ -35,7 +35,10 @@ namespace swift {
   class SILLocation;
   class DominanceInfo;
 
-  enum class ValueKind {
+  /// The underlying type is fixed at 8 bits: the enum is well under 256
+  /// entries, and narrowing the ValueBase::Kind member leaves the
+  /// adjacent padding bytes free for future per-node flags.
+  enum class ValueKind : uint8_t {
 #define VALUE(Id, Parent) Id,
 #define VALUE_RANGE(Id, FirstId, LastId) \
     First_##Id = FirstId, Last_##Id = LastId,
@@ -51,6 +54,8 @@ namespace swift {
 /// represents a runtime computed value.  Things like SILInstruction derive
 /// from this.
 class alignas(8) ValueBase : public SILAllocated<ValueBase> {
+  /// The single result type of this value, stored inline so that getType()
+  /// is a plain field load with no discriminator to test.
   SILType Type;
   Operand *FirstUse = nullptr;
   friend class Operand;
@@ -70,13 +75,14 @@ public:
   }
 
 
-  ValueKind getKind() const { return Kind; }
+  ValueKind getKind() const LLVM_READONLY { return Kind; }
 
   /// True if the "value" is actually a value that can be used by other
-  /// instructions.
-  bool hasValue() const { return !Type.isNull(); }
+  /// instructions.  This is a null test on the inline type; there is no
+  /// separate type-list representation to discriminate.
+  bool hasValue() const LLVM_READONLY { return !Type.isNull(); }
 
-  SILType getType() const {
+  SILType getType() const LLVM_READONLY {
     return Type;
   }
 
@@ -89,7 +95,7 @@ public:
   /// Returns true if this value has no uses.
   /// To ignore debug-info instructions use swift::onlyHaveDebugUses instead
   /// (see comment in DebugUtils.h).
-  bool use_empty() const { return FirstUse == nullptr; }
+  bool use_empty() const LLVM_READONLY { return FirstUse == nullptr; }
 
   using use_iterator = ValueBaseUseIterator;
 
@@ -104,9 +110,13 @@ public:
   /// Returns true if this value has exactly one use.
   /// To ignore debug-info instructions use swift::hasOneNonDebugUse instead
   /// (see comment in DebugUtils.h).
-  inline bool hasOneUse() const;
+  inline bool hasOneUse() const LLVM_READONLY;
 
   /// Pretty-print the value.
+  ///
+  /// These dispatch over the kind via SILVisitor's switch on the dense
+  /// ValueKind enum rather than through virtual functions, which keeps
+  /// ValueBase free of a vtable pointer.
   void dump() const;
   void print(raw_ostream &OS) const;
 
@@ -157,6 +167,10 @@ public:
 namespace swift {
 
 /// SILValue - A SILValue is a wrapper around a ValueBase pointer.
+///
+/// The representation is a bare pointer with no tag bits, so conversions
+/// and comparisons compile to plain pointer operations with no
+/// mask/shift sequences.
 class SILValue {
   ValueBase *Value;
 
@@ -208,12 +222,18 @@ class Operand {
   /// designated result.
   Operand *NextUse = nullptr;
 
-  /// A back-pointer in the use-chain, required for fast patching
-  /// of use-chains.
-  Operand **Back = nullptr;
+  /// The previous operand in the use-chain, or null if this operand is
+  /// the head of the chain (or is not linked into a chain at all).
+  /// Required for fast patching of use-chains.
+  Operand *Prev = nullptr;
 
   /// The owner of this operand.
-  /// FIXME: this could be space-compressed.
+  ///
+  /// FIXME: this could be space-compressed.  Recovering the owner from the
+  /// operand's own address would need a per-kind table of operand-list
+  /// offsets plus a per-operand index; the index does not fit in the spare
+  /// low bits of NextUse for large operand lists (e.g. applies), and the
+  /// offset table cannot be consulted without already knowing the owner.
   SILInstruction *Owner;
 
   Operand(SILInstruction *owner) : Owner(owner) {}
@@ -230,7 +250,7 @@ public:
   Operand &operator=(const Operand &use) = delete;
 
   /// Return the current value being used by this operand.
-  SILValue get() const { return TheValue; }
+  SILValue get() const LLVM_READONLY { return TheValue; }
 
   /// Set the current value being used by this operand.
   void set(SILValue newValue) {
@@ -253,7 +273,7 @@ public:
     removeFromCurrent();
     TheValue = SILValue();
     NextUse = nullptr;
-    Back = nullptr;
+    Prev = nullptr;
     Owner = nullptr;
   }
 
@@ -262,29 +282,45 @@ public:
   }
 
   /// Return the user that owns this use.
-  SILInstruction *getUser() { return Owner; }
-  const SILInstruction *getUser() const { return Owner; }
+  SILInstruction *getUser() LLVM_READONLY { return Owner; }
+  const SILInstruction *getUser() const LLVM_READONLY { return Owner; }
 
   /// getOperandNumber - Return which operand this is in the operand list of the
   /// using instruction.
-  unsigned getOperandNumber() const;
+  unsigned getOperandNumber() const LLVM_READONLY;
 
 private:
   void removeFromCurrent() {
-    if (!Back) return;
-    *Back = NextUse;
-    if (NextUse) NextUse->Back = Back;
+    // An operand is linked into its value's use-chain exactly when it has
+    // a value; a fully-constructed operand almost always does.
+    if (LLVM_UNLIKELY(!TheValue)) return;
+    // Select the forward link to patch: our predecessor's NextUse, or the
+    // chain's head pointer if we are the head.
+    Operand **nextSlot = Prev ? &Prev->NextUse : &TheValue->FirstUse;
+    *nextSlot = NextUse;
+    // Patch the next use's previous-pointer unconditionally.  If this was
+    // the last use in the chain, aim the store at our own Prev slot
+    // instead, which is dead after unlinking; this trades the
+    // data-dependent branch on NextUse for a select that lowers to a
+    // conditional move.
+    Operand **prevSlot = NextUse ? &NextUse->Prev : &Prev;
+    *prevSlot = Prev;
   }
 
   void insertIntoCurrent() {
-    Back = &TheValue->FirstUse;
     NextUse = TheValue->FirstUse;
-    if (NextUse) NextUse->Back = &NextUse;
+    // Patch the old head's previous-pointer unconditionally.  If the chain
+    // was empty, aim the store at our own Prev slot instead, which is
+    // overwritten immediately below; this trades the data-dependent branch
+    // on NextUse for a select that lowers to a conditional move.
+    Operand **prevSlot = NextUse ? &NextUse->Prev : &Prev;
+    *prevSlot = this;
+    Prev = nullptr;
     TheValue->FirstUse = this;
   }
 
+  friend class ValueBase;
   friend class ValueBaseUseIterator;
-  friend class ValueUseIterator;
   template <unsigned N> friend class FixedOperandList;
   template <unsigned N> friend class TailAllocatedOperandList;
   friend class TrailingOperandsList;
@@ -300,15 +336,38 @@ public:
   explicit OperandValueArrayRef(ArrayRef<Operand> operands)
     : Operands(operands) {}
 
-  /// A simple iterator adapter.
-  class iterator {
+  /// A simple iterator adapter.  It strides directly over the underlying
+  /// Operand array and advertises random-access traits, so distance and
+  /// advancement are constant-time pointer arithmetic and clients that
+  /// range-construct a container (e.g. SmallVector) can reserve up front
+  /// instead of growing incrementally.
+  class iterator : public std::iterator<std::random_access_iterator_tag,
+                                        SILValue, ptrdiff_t> {
     const Operand *Ptr;
   public:
     iterator(const Operand *ptr) : Ptr(ptr) {}
     SILValue operator*() const { assert(Ptr); return Ptr->get(); }
     SILValue operator->() const { return operator*(); }
+    SILValue operator[](ptrdiff_t i) const { return Ptr[i].get(); }
     iterator &operator++() { ++Ptr; return *this; }
     iterator operator++(int) { iterator copy = *this; ++Ptr; return copy; }
+    iterator &operator--() { --Ptr; return *this; }
+    iterator operator--(int) { iterator copy = *this; --Ptr; return copy; }
+    iterator &operator+=(ptrdiff_t n) { Ptr += n; return *this; }
+    iterator &operator-=(ptrdiff_t n) { Ptr -= n; return *this; }
+
+    friend iterator operator+(iterator lhs, ptrdiff_t n) {
+      return iterator(lhs.Ptr + n);
+    }
+    friend iterator operator+(ptrdiff_t n, iterator rhs) {
+      return iterator(rhs.Ptr + n);
+    }
+    friend iterator operator-(iterator lhs, ptrdiff_t n) {
+      return iterator(lhs.Ptr - n);
+    }
+    friend ptrdiff_t operator-(iterator lhs, iterator rhs) {
+      return lhs.Ptr - rhs.Ptr;
+    }
 
     friend bool operator==(iterator lhs, iterator rhs) {
       return lhs.Ptr == rhs.Ptr;
@@ -316,6 +375,18 @@ public:
     friend bool operator!=(iterator lhs, iterator rhs) {
       return lhs.Ptr != rhs.Ptr;
     }
+    friend bool operator<(iterator lhs, iterator rhs) {
+      return lhs.Ptr < rhs.Ptr;
+    }
+    friend bool operator<=(iterator lhs, iterator rhs) {
+      return lhs.Ptr <= rhs.Ptr;
+    }
+    friend bool operator>(iterator lhs, iterator rhs) {
+      return lhs.Ptr > rhs.Ptr;
+    }
+    friend bool operator>=(iterator lhs, iterator rhs) {
+      return lhs.Ptr >= rhs.Ptr;
+    }
   };
 
   iterator begin() const { return iterator(Operands.begin()); }
@@ -396,9 +467,7 @@ inline iterator_range<ValueBase::use_iterator> ValueBase::getUses() const {
   return { use_begin(), use_end() };
 }
 inline bool ValueBase::hasOneUse() const {
-  auto I = use_begin(), E = use_end();
-  if (I == E) return false;
-  return ++I == E;
+  return FirstUse && !FirstUse->NextUse;
 }
 
 /// A constant-size list of the operands of an instruction.
@@ -409,6 +478,9 @@ template <unsigned N> class FixedOperandList {
   FixedOperandList &operator=(const FixedOperandList &) = delete;
 
 public:
+  /// The pack expansion constructs each operand in place; there is no
+  /// runtime loop over N, so small fixed lists need no per-N
+  /// specializations to be fully unrolled.
   template <class... T> FixedOperandList(SILInstruction *user, T&&...args)
       : Buffer{ { user, std::forward<T>(args) }... } {
     static_assert(sizeof...(args) == N, "wrong number of initializers");
@@ -442,6 +514,11 @@ public:
 /// This class assumes that a number of bytes of extra storage have
 /// been allocated immediately after it.  This means that this class
 /// must always be the final data member in a class.
+///
+/// Operands are deliberately stored as an array of complete Operand
+/// objects rather than split into parallel value/link arrays: use-chains
+/// and clients alike traffic in Operand pointers, so a value's identity
+/// and its chain links must stay at a single stable address.
 template <unsigned N> class TailAllocatedOperandList {
   unsigned NumExtra;
   Operand Buffer[N];
@@ -501,8 +578,14 @@ public:
 
 
   ~TailAllocatedOperandList() {
-    for (auto &op : getDynamicAsArray()) {
-      op.~Operand();
+    // Tear down the dynamic operands in reverse order of construction.
+    // Each operand was inserted at the head of its value's use-chain, so
+    // when several of these operands share a value the reverse walk
+    // unlinks at the head each time, touching only the head pointer and
+    // the next use's Prev instead of chasing into the chain.
+    MutableArrayRef<Operand> dynamicOps = getDynamicAsArray();
+    for (unsigned i = dynamicOps.size(); i != 0; --i) {
+      dynamicOps[i-1].~Operand();
     }
   }
 
@@ -533,6 +616,7 @@ public:
   }
 
   unsigned size() const { return N+NumExtra; }
+  bool empty() const { return size() == 0; }
 
   /// Indexes into the full list of operands.
   Operand &operator[](unsigned i) { return asArray()[i]; }
@@ -542,7 +626,11 @@ public:
 /// A specialization of TailAllocatedOperandList for zero static operands.
 template<> class TailAllocatedOperandList<0> {
   unsigned NumExtra;
-  union { // suppress value semantics
+  // The union suppresses value semantics; Operand has a non-trivial
+  // destructor, which also rules out declaring Buffer as a zero-length
+  // array, so the empty case carries one uninitialized slot that
+  // getExtraSize() compensates for.
+  union {
     Operand Buffer[1];
   };
 
@@ -564,8 +652,11 @@ public:
   }
 
   ~TailAllocatedOperandList() {
-    for (auto &op : getDynamicAsArray()) {
-      op.~Operand();
+    // As in the primary template, destroy in reverse so operands sharing
+    // a value unlink from the head of its use-chain.
+    MutableArrayRef<Operand> dynamicOps = getDynamicAsArray();
+    for (unsigned i = dynamicOps.size(); i != 0; --i) {
+      dynamicOps[i-1].~Operand();
     }
   }
 
@@ -596,6 +687,7 @@ public:
   }
 
   unsigned size() const { return NumExtra; }
+  bool empty() const { return NumExtra == 0; }
 
   /// Indexes into the full list of operands.
   Operand &operator[](unsigned i) { return asArray()[i]; }
@@ -668,7 +760,8 @@ namespace llvm {
                                   llvm::DenseMapInfo<void*>::getTombstoneKey());
     }
     static unsigned getHashValue(swift::SILValue V) {
-      return DenseMapInfo<swift::ValueBase *>::getHashValue(V);
+      // Hash the full opaque representation, matching operator==.
+      return DenseMapInfo<void *>::getHashValue(V.getOpaqueValue());
     }
     static bool isEqual(swift::SILValue LHS, swift::SILValue RHS) {
       return LHS == RHS;
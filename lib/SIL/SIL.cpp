@@ -31,8 +31,12 @@ using namespace swift;
 
 void ValueBase::replaceAllUsesWith(ValueBase *RHS) {
   assert(this != RHS && "Cannot RAUW a value with itself");
-  while (!use_empty()) {
-    Operand *Op = *use_begin();
+  // Advance past each use before rewiring it: set() splices the operand
+  // into RHS's use-chain, and stepping first also decouples the load of
+  // the next use from the stores that relink the current one.
+  for (auto UI = use_begin(), E = use_end(); UI != E;) {
+    Operand *Op = *UI;
+    ++UI;
     Op->set(RHS);
   }
 }
@@ -107,6 +107,10 @@ void *SILModule::allocate(unsigned Size, unsigned Align) const {
 }
 
 void *SILModule::allocateInst(unsigned Size, unsigned Align) const {
+  // Instruction memory must stay individually freeable for
+  // deallocateInst, so it cannot be routed into bump arenas (e.g.
+  // per-kind pools for locality); the system allocator's size classes
+  // provide the clustering instead.
   return AlignedAlloc(Size, Align);
 }
 